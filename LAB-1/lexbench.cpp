@@ -0,0 +1,381 @@
+// Lexer throughput benchmark.
+//
+// Generates deterministic corpora in the LAB-1 keyword/operator language and
+// times one or more lexer executables on them, reporting MB/s, tokens/s and
+// peak RSS per run. Results can be saved as a baseline and compared later.
+//
+//   lexbench --exe="lab1=./lexer --quiet {}" --exe="flex=../LAB-4/lexer {}"
+//            --sizes=1M,100M,1G --save=baseline.txt
+//   lexbench --exe="lab1=./lexer --quiet {}" --compare=baseline.txt
+//
+// "{}" in a command is replaced by the corpus path. Each run's stdout goes
+// to /dev/null and it runs inside the corpus directory, so lexers that write
+// side files (LAB-4 writes tokens.txt) keep them there. Token counts are the
+// LAB-1 token counts of the corpus, known exactly from generation, and are
+// used for every lexer: the "LAB-1 Mtok/s" column is that count over each
+// lexer's time, not the number of tokens the lexer itself produced. A run
+// that exits non-zero or is killed by a signal is reported as failed, is
+// left out of --save, and makes lexbench exit with status 1.
+// POSIX only (fork/exec/wait4).
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace std;
+
+const char* keywordList[] = {
+    "main", "if", "then", "else", "while", "do", "repeat", "until", "for", "from",
+    "to", "step", "switch", "of", "case", "default", "return", "integer", "real",
+    "char", "bool", "and", "or", "not", "mod", "read", "write"
+};
+
+// Operators and delimiters understood by both LAB-1 and the LAB-4 scanner.
+const char* operatorList[] = {"=", "==", "<", "<=", ">", ">=", "!=", "+", "-", "*", "/"};
+const char* delimiterList[] = {",", ";", ":", "(", ")", "{", "}", "[", "]"};
+
+// splitmix64: small, fast and fully deterministic across platforms.
+struct Rng {
+    uint64_t state;
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    size_t below(size_t n) { return (size_t)(next() % n); }
+};
+
+// Corpus writer: appends pieces to a buffer, flushes it to the file in large
+// blocks and keeps the LAB-1 token count.
+class Corpus {
+public:
+    explicit Corpus(FILE* out) : out(out) { buf.reserve(1 << 20); }
+    ~Corpus() { flush(); }
+
+    void token(const string& s) {
+        buf += s;
+        ++tokens;
+    }
+    void text(const string& s) { buf += s; }  // whitespace and comments
+    void flush() {
+        fwrite(buf.data(), 1, buf.size(), out);
+        bytes += buf.size();
+        buf.clear();
+    }
+    void maybeFlush() {
+        if (buf.size() >= (1 << 20)) flush();
+    }
+    size_t written() const { return bytes + buf.size(); }
+
+    uint64_t tokens = 0;
+
+private:
+    FILE* out;
+    string buf;
+    size_t bytes = 0;
+};
+
+// Identifier from a fixed pool (heavy reuse, like real sources). LAB-4 has
+// no '_' in identifiers, so none are generated.
+string identifier(Rng& rng, size_t pool) {
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    Rng name{rng.below(pool) * 0x2545F4914F6CDD1Dull};
+    size_t len = 3 + name.below(14);
+    string s;
+    for (size_t i = 0; i < len; ++i)
+        s += i && name.below(4) == 0 ? (char)('0' + name.below(10)) : letters[name.below(52)];
+    // Keep generated names from colliding with keywords.
+    for (const char* k : keywordList)
+        if (s == k) s += 'x';
+    return s;
+}
+
+string number(Rng& rng) {
+    static const uint64_t limits[] = {10, 1000, 100000, 100000000, 1000000000000ull};
+    return to_string(rng.next() % limits[rng.below(5)]);
+}
+
+// One "line" of each corpus profile.
+void identLine(Corpus& c, Rng& rng) {
+    c.text(string(rng.below(3) * 4, ' '));
+    if (rng.below(5) == 0) {
+        c.token(keywordList[rng.below(27)]);
+        c.text(" ");
+    }
+    c.token(identifier(rng, 5000));
+    c.text(" ");
+    c.token("=");
+    for (size_t i = 0, n = 1 + rng.below(4); i < n; ++i) {
+        c.text(" ");
+        c.token(identifier(rng, 5000));
+        c.text(" ");
+        c.token(i + 1 < n ? operatorList[7 + rng.below(4)] : ";");
+    }
+    c.text("\n");
+}
+
+void numberLine(Corpus& c, Rng& rng) {
+    for (size_t i = 0, n = 4 + rng.below(12); i < n; ++i) {
+        c.token(number(rng));
+        c.token(i + 1 < n ? "," : ";");
+        c.text(" ");
+    }
+    c.text("\n");
+}
+
+void commentLine(Corpus& c, Rng& rng) {
+    string words;
+    for (size_t i = 0, n = 3 + rng.below(12); i < n; ++i) words += identifier(rng, 500) + " ";
+    if (rng.below(2)) {
+        c.text("// " + words + "\n");
+    } else {
+        c.text("/* " + words + "\n   " + words + "*/\n");
+    }
+    c.token(identifier(rng, 500));
+    c.token("=");
+    c.token(number(rng));
+    c.token(";");
+    c.text("\n");
+}
+
+void operatorLine(Corpus& c, Rng& rng) {
+    c.token("(");
+    for (size_t i = 0, n = 6 + rng.below(10); i < n; ++i) {
+        c.token(string(1, (char)('a' + rng.below(26))));
+        const char* op = operatorList[rng.below(11)];
+        c.token(op);
+        if (rng.below(4) == 0) c.token(delimiterList[rng.below(9)]);
+        if (op[0] == '/') c.text(" ");  // keep "/" from opening a comment
+    }
+    c.token("z");
+    c.token(")");
+    c.token(";");
+    c.text("\n");
+}
+
+typedef void (*LineGenerator)(Corpus&, Rng&);
+
+struct Profile {
+    const char* name;
+    LineGenerator line;
+};
+
+const Profile profiles[] = {
+    {"ident", identLine}, {"number", numberLine}, {"comment", commentLine}, {"operator", operatorLine}
+};
+
+// Write (or reuse) the corpus for profile/size; returns its token count,
+// which is stored next to it in "<path>.tokens".
+uint64_t makeCorpus(size_t profile, size_t size, const string& path) {
+    struct stat st;
+    ifstream countIn(path + ".tokens");
+    uint64_t tokens = 0;
+    if (stat(path.c_str(), &st) == 0 && (size_t)st.st_size >= size && countIn >> tokens) return tokens;
+
+    FILE* fp = fopen(path.c_str(), "wb");
+    if (!fp) {
+        cerr << "Error: Cannot create " << path << "\n";
+        exit(1);
+    }
+    Rng rng{size * 31 + profile};
+    {
+        Corpus c(fp);
+        while (c.written() < size) {
+            profiles[profile].line(c, rng);
+            c.maybeFlush();
+        }
+        tokens = c.tokens;
+    }
+    fclose(fp);
+    ofstream(path + ".tokens") << tokens << "\n";
+    return tokens;
+}
+
+struct RunResult {
+    double seconds;
+    long peakRssKb;
+    int status;
+};
+
+// Run `argv` inside `dir` with stdout discarded; wall time and peak RSS.
+RunResult runOnce(const vector<string>& argv, const string& dir) {
+    vector<char*> args;
+    for (const string& a : argv) args.push_back(const_cast<char*>(a.c_str()));
+    args.push_back(nullptr);
+
+    auto t0 = chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) dup2(devnull, STDOUT_FILENO);
+        if (chdir(dir.c_str()) != 0) _exit(127);
+        execvp(args[0], args.data());
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    if (pid < 0 || wait4(pid, &status, 0, &usage) < 0) status = 127 << 8;
+    auto t1 = chrono::steady_clock::now();
+    return RunResult{chrono::duration<double>(t1 - t0).count(), usage.ru_maxrss, status};
+}
+
+// "" for a clean exit, otherwise what went wrong with the run.
+string failure(int status) {
+    if (WIFSIGNALED(status))
+        return "killed by signal " + to_string(WTERMSIG(status)) + " (" + strsignal(WTERMSIG(status)) + ")";
+    if (WIFEXITED(status) && WEXITSTATUS(status) != 0) return "exit status " + to_string(WEXITSTATUS(status));
+    if (!WIFEXITED(status)) return "did not exit";
+    return "";
+}
+
+size_t parseSize(const string& s) {
+    char* end = nullptr;
+    double v = strtod(s.c_str(), &end);
+    switch (end && *end ? toupper(*end) : 0) {
+    case 'K': v *= 1 << 10; break;
+    case 'M': v *= 1 << 20; break;
+    case 'G': v *= 1 << 30; break;
+    }
+    return (size_t)v;
+}
+
+vector<string> split(const string& s, char sep) {
+    vector<string> parts;
+    string part;
+    istringstream in(s);
+    while (getline(in, part, sep))
+        if (!part.empty()) parts.push_back(part);
+    return parts;
+}
+
+string absolutePath(const string& path) {
+    char buf[PATH_MAX];
+    return realpath(path.c_str(), buf) ? string(buf) : path;
+}
+
+void printUsage() {
+    cout << "Usage: lexbench --exe=LABEL=COMMAND [--exe=...] [options]\n"
+            "  --exe=LABEL=CMD    lexer command to time; {} is replaced by the corpus path\n"
+            "  --sizes=LIST       corpus sizes, e.g. 1M,10M,100M,1G (default 1M,10M,100M)\n"
+            "  --profiles=LIST    ident,number,comment,operator (default all)\n"
+            "  --dir=DIR          where corpora are generated (default lexbench-corpus)\n"
+            "  --repeat=N         runs per measurement, best one is kept (default 3)\n"
+            "  --save=FILE        record the results as a baseline\n"
+            "  --compare=FILE     show the change against a recorded baseline\n";
+}
+
+int main(int argc, char* argv[]) {
+    vector<pair<string, string>> exes;
+    vector<string> sizeList = {"1M", "10M", "100M"};
+    vector<string> profileList;
+    string dir = "lexbench-corpus", saveFile, compareFile;
+    int repeat = 3;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string key = arg.substr(0, eq), val = eq == string::npos ? "" : arg.substr(eq + 1);
+        if (key == "--exe" && val.find('=') != string::npos) {
+            exes.push_back({val.substr(0, val.find('=')), val.substr(val.find('=') + 1)});
+        } else if (key == "--sizes") {
+            sizeList = split(val, ',');
+        } else if (key == "--profiles") {
+            profileList = split(val, ',');
+        } else if (key == "--dir") {
+            dir = val;
+        } else if (key == "--repeat") {
+            repeat = max(1, atoi(val.c_str()));
+        } else if (key == "--save") {
+            saveFile = val;
+        } else if (key == "--compare") {
+            compareFile = val;
+        } else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (exes.empty()) {
+        printUsage();
+        return 1;
+    }
+    mkdir(dir.c_str(), 0755);
+    dir = absolutePath(dir);
+
+    // Baseline rows are keyed by "label profile size".
+    map<string, double> baseline;
+    if (!compareFile.empty()) {
+        ifstream in(compareFile);
+        string label, profile, size;
+        double mbps, tokps;
+        long rss;
+        while (in >> label >> profile >> size >> mbps >> tokps >> rss)
+            baseline[label + " " + profile + " " + size] = mbps;
+    }
+    ofstream save;
+    if (!saveFile.empty()) save.open(saveFile);
+
+    bool anyFailed = false;
+    printf("%-10s %-9s %8s %10s %10s %12s %10s%s\n", "lexer", "profile", "size", "seconds",
+           "MB/s", "LAB-1 Mtok/s", "peak MB", compareFile.empty() ? "" : "  vs base");
+    for (size_t pi = 0; pi < sizeof(profiles) / sizeof(profiles[0]); ++pi) {
+        const Profile& profile = profiles[pi];
+        if (!profileList.empty() && find(profileList.begin(), profileList.end(), profile.name) == profileList.end())
+            continue;
+        for (const string& sizeName : sizeList) {
+            size_t size = parseSize(sizeName);
+            string path = dir + "/" + profile.name + "-" + sizeName + ".txt";
+            uint64_t tokens = makeCorpus(pi, size, path);
+            struct stat st;
+            stat(path.c_str(), &st);
+            double mb = st.st_size / 1e6;
+
+            for (auto& [label, command] : exes) {
+                vector<string> args = split(command, ' ');
+                for (string& a : args) {
+                    size_t at = a.find("{}");
+                    if (at != string::npos) a.replace(at, 2, path);
+                }
+                if (!args.empty() && args[0].find('/') != string::npos) args[0] = absolutePath(args[0]);
+
+                RunResult best{1e300, 0, 0};
+                for (int r = 0; r < repeat; ++r) {
+                    RunResult res = runOnce(args, dir);
+                    if (res.status != 0) best.status = res.status;
+                    if (res.seconds < best.seconds) best.seconds = res.seconds;
+                    best.peakRssKb = max(best.peakRssKb, res.peakRssKb);
+                }
+                double mbps = mb / best.seconds, mtokps = tokens / 1e6 / best.seconds;
+                printf("%-10s %-9s %8s %10.3f %10.1f %12.2f %10.1f", label.c_str(), profile.name,
+                       sizeName.c_str(), best.seconds, mbps, mtokps, best.peakRssKb / 1024.0);
+                auto base = baseline.find(label + " " + profile.name + " " + sizeName);
+                if (base != baseline.end()) printf("  %+7.1f%%", (mbps / base->second - 1) * 100);
+                string failed = failure(best.status);
+                if (!failed.empty()) {
+                    printf("  FAILED: %s", failed.c_str());
+                    anyFailed = true;
+                }
+                printf("\n");
+                fflush(stdout);
+                if (save.is_open() && failed.empty()) {
+                    save << label << " " << profile.name << " " << sizeName << " " << mbps << " "
+                         << mtokps * 1e6 << " " << best.peakRssKb << "\n";
+                }
+            }
+        }
+    }
+    return anyFailed ? 1 : 0;
+}
@@ -1,20 +1,278 @@
 #include <iostream>
-#include <fstream>
 #include <string>
 #include <cctype>
 #include <map>
 #include <vector>
+#include <string_view>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <charconv>
+#include <memory>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
 // Token structure
 struct Token {
     int syn;           // Category code
-    string token;      // Lexeme
-    int sum;           // Numeric value (for NUM)
+    string_view token; // Lexeme (points into the SourceBuffer)
+    int64_t sum;       // Numeric value (for NUM)
+    bool overflow;     // NUM did not fit in 64 bits (sum is INT64_MAX)
+};
+
+// Identifier intern table. Each distinct identifier is copied once into an
+// arena and gets a dense id in order of first occurrence, so later phases
+// can compare ids instead of strings. Open addressing with linear probing;
+// the table stays at most half full.
+class SymbolTable {
+public:
+    static const uint32_t NONE = UINT32_MAX;
+
+    uint32_t intern(string_view s) {
+        if ((names.size() + 1) * 2 > slots.size()) grow();
+        uint64_t h = hash(s);
+        size_t mask = slots.size() - 1;
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            if (slot.id == NONE) {
+                slot = Slot{(uint32_t)names.size(), (uint32_t)(h >> 32)};
+                names.push_back(store(s));
+                return slot.id;
+            }
+            if (slot.tag == (uint32_t)(h >> 32) && names[slot.id] == s) return slot.id;
+        }
+    }
+
+    uint32_t find(string_view s) const {
+        if (slots.empty()) return NONE;
+        uint64_t h = hash(s);
+        size_t mask = slots.size() - 1;
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            const Slot& slot = slots[i];
+            if (slot.id == NONE) return NONE;
+            if (slot.tag == (uint32_t)(h >> 32) && names[slot.id] == s) return slot.id;
+        }
+    }
+
+    string_view name(uint32_t id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+private:
+    struct Slot {
+        uint32_t id;   // symbol id, or NONE when empty
+        uint32_t tag;  // high hash bits, checked before the string compare
+    };
+    vector<Slot> slots;
+    vector<string_view> names;         // per symbol id, pointing into arena
+    vector<unique_ptr<char[]>> arena;
+    size_t arenaLeft = 0;
+    char* arenaNext = nullptr;
+
+    static uint64_t hash(string_view s) {
+        uint64_t h = 0x9E3779B97F4A7C15ull ^ s.size();
+        size_t i = 0;
+        for (; i + 8 <= s.size(); i += 8) {
+            uint64_t w;
+            memcpy(&w, s.data() + i, 8);
+            h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+        for (; i < s.size(); ++i) h = (h ^ (unsigned char)s[i]) * 0x100000001B3ull;
+        return h ^ (h >> 29);
+    }
+
+    string_view store(string_view s) {
+        const size_t block = 64 * 1024;
+        if (s.size() > arenaLeft) {
+            size_t n = max(block, s.size());
+            arena.emplace_back(new char[n]);
+            arenaNext = arena.back().get();
+            arenaLeft = n;
+        }
+        memcpy(arenaNext, s.data(), s.size());
+        string_view stored(arenaNext, s.size());
+        arenaNext += s.size();
+        arenaLeft -= s.size();
+        return stored;
+    }
+
+    void grow() {
+        vector<Slot> bigger(max<size_t>(64, slots.size() * 2), Slot{NONE, 0});
+        size_t mask = bigger.size() - 1;
+        for (uint32_t id = 0; id < names.size(); ++id) {
+            size_t i = hash(names[id]) & mask;
+            while (bigger[i].id != NONE) i = (i + 1) & mask;
+            bigger[i] = Slot{id, (uint32_t)(hash(names[id]) >> 32)};
+        }
+        slots.swap(bigger);
+    }
+};
+
+// Token flags
+const uint8_t TOKEN_OVERFLOW = 1;  // NUM value exceeds INT64_MAX
+
+// Token stream in structure-of-arrays form: one parallel array per field,
+// so consumers walking a single field touch only that field's cache lines
+// and scanning never allocates per lexeme. Offsets are relative to `base`.
+struct TokenStream {
+    const char* base = nullptr;
+    vector<uint16_t> kind;     // Category code (syn)
+    vector<uint32_t> offset;   // Start of the lexeme in base
+    vector<uint32_t> length;   // Lexeme length in bytes
+    vector<int64_t> value;     // NUM: numeric value, identifier: symbol id, else -1
+    vector<uint8_t> flags;     // TOKEN_OVERFLOW
+    vector<uint32_t> unknown;  // Offsets of ignored unknown symbols
+    SymbolTable symbols;       // Identifiers seen in this stream
+
+    size_t size() const { return kind.size(); }
+
+    void reserve(size_t n) {
+        kind.reserve(n);
+        offset.reserve(n);
+        length.reserve(n);
+        value.reserve(n);
+        flags.reserve(n);
+    }
+
+    void push(int syn, const char* start, size_t len, int64_t sum, uint8_t flag = 0) {
+        kind.push_back((uint16_t)syn);
+        offset.push_back((uint32_t)(start - base));
+        length.push_back((uint32_t)len);
+        value.push_back(sum);
+        flags.push_back(flag);
+    }
+
+    void pushIdentifier(const char* start, size_t len) {
+        push(100, start, len, symbols.intern(string_view(start, len)));  // Identifier code
+    }
+
+    string_view text(size_t i) const { return string_view(base + offset[i], length[i]); }
+
+    // Symbol id of an identifier token, SymbolTable::NONE for other kinds.
+    uint32_t symbol(size_t i) const { return kind[i] == 100 ? (uint32_t)value[i] : SymbolTable::NONE; }
+
+    // The classic "sum" field: numeric value for NUM, -1 for everything else.
+    int64_t sum(size_t i) const { return kind[i] == 100 ? -1 : value[i]; }
+
+    bool overflow(size_t i) const { return flags[i] & TOKEN_OVERFLOW; }
+
+    Token operator[](size_t i) const { return Token{kind[i], text(i), sum(i), overflow(i)}; }
+
+    // Append a stream scanned over the same base (used to stitch chunks).
+    // Its identifiers are re-interned here, so ids stay in order of first
+    // occurrence across the joined stream.
+    void append(const TokenStream& other) {
+        vector<uint32_t> remap(other.symbols.size());
+        for (uint32_t id = 0; id < remap.size(); ++id)
+            remap[id] = symbols.intern(other.symbols.name(id));
+        size_t first = size();
+        kind.insert(kind.end(), other.kind.begin(), other.kind.end());
+        offset.insert(offset.end(), other.offset.begin(), other.offset.end());
+        length.insert(length.end(), other.length.begin(), other.length.end());
+        value.insert(value.end(), other.value.begin(), other.value.end());
+        flags.insert(flags.end(), other.flags.begin(), other.flags.end());
+        unknown.insert(unknown.end(), other.unknown.begin(), other.unknown.end());
+        for (size_t i = first; i < size(); ++i)
+            if (kind[i] == 100) value[i] = remap[value[i]];
+    }
+};
+
+// Whole input file as one contiguous byte range.
+// Regular files are memory-mapped; pipes ("-" = stdin) and anything that
+// cannot be mapped are read into a heap buffer in large blocks instead.
+class SourceBuffer {
+public:
+    explicit SourceBuffer(const string& filename) {
+        if (filename != "-" && mapFile(filename)) return;
+        readStream(filename);
+    }
+    ~SourceBuffer() {
+#ifndef _WIN32
+        if (mapped) munmap(const_cast<char*>(data), length);
+#endif
+    }
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    const char* begin() const { return data; }
+    const char* end() const { return data + length; }
+    size_t size() const { return length; }
+    bool isMapped() const { return mapped; }
+
+private:
+    const char* data = "";
+    size_t length = 0;
+    bool mapped = false;
+    vector<char> storage;  // fallback copy when the file is not mapped
+
+    bool mapFile(const string& filename) {
+#ifdef _WIN32
+        (void)filename;
+        return false;
+#else
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            cerr << "Error: Cannot open file.\n";
+            exit(1);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) return false;
+        madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(p);
+        length = (size_t)st.st_size;
+        mapped = true;
+        return true;
+#endif
+    }
+
+    void readStream(const string& filename) {
+        FILE* fp = filename == "-" ? stdin : fopen(filename.c_str(), "rb");
+        if (!fp) {
+            cerr << "Error: Cannot open file.\n";
+            exit(1);
+        }
+        const size_t block = 1 << 20;
+        size_t n;
+        do {
+            storage.resize(length + block);
+            n = fread(storage.data() + length, 1, block, fp);
+            length += n;
+        } while (n == block);
+        storage.resize(length);
+        if (fp != stdin) fclose(fp);
+        if (length) data = storage.data();
+    }
 };
 
 // Define keywords
-map<string, int> keywords = {
+struct Keyword {
+    const char* name;
+    int syn;
+};
+
+constexpr Keyword keywords[] = {
     {"main", 1}, {"if", 2}, {"then", 3}, {"else", 4}, {"while", 5}, {"do", 6},
     {"repeat", 7}, {"until", 8}, {"for", 9}, {"from", 10}, {"to", 11}, {"step", 12},
     {"switch", 13}, {"of", 14}, {"case", 15}, {"default", 16}, {"return", 17},
@@ -22,149 +280,957 @@ map<string, int> keywords = {
     {"or", 23}, {"not", 24}, {"mod", 25}, {"read", 26}, {"write", 27}
 };
 
+// Perfect hash for the keyword set. Length, first and last character alone
+// do not separate "while" from "write", so the second character is mixed in
+// as well. Keywords are 2..7 characters long; anything else is never probed.
+const size_t KEYWORD_MIN_LEN = 2, KEYWORD_MAX_LEN = 7, KEYWORD_SLOTS = 64;
+
+constexpr size_t keywordHash(const char* s, size_t n) {
+    return (n + (unsigned char)s[0] + 13 * (unsigned char)s[1] + 7 * (unsigned char)s[n - 1])
+           & (KEYWORD_SLOTS - 1);
+}
+
+constexpr size_t constexprStrlen(const char* s) {
+    size_t n = 0;
+    while (s[n]) ++n;
+    return n;
+}
+
+struct KeywordSlot {
+    char name[KEYWORD_MAX_LEN + 1];
+    uint8_t len;
+    uint8_t syn;
+};
+
+struct KeywordTable {
+    KeywordSlot slot[KEYWORD_SLOTS];
+    bool perfect;
+};
+
+constexpr KeywordTable buildKeywordTable() {
+    KeywordTable t{};
+    t.perfect = true;
+    for (const Keyword& k : keywords) {
+        size_t n = constexprStrlen(k.name);
+        KeywordSlot& s = t.slot[keywordHash(k.name, n)];
+        if (s.len != 0 || n < KEYWORD_MIN_LEN || n > KEYWORD_MAX_LEN) t.perfect = false;
+        for (size_t i = 0; i < n; ++i) s.name[i] = k.name[i];
+        s.len = (uint8_t)n;
+        s.syn = (uint8_t)k.syn;
+    }
+    return t;
+}
+
+constexpr KeywordTable keywordTable = buildKeywordTable();
+static_assert(keywordTable.perfect, "keyword hash has a collision; pick new multipliers");
+
+// Keyword code for s[0..n), or 0 if it is an ordinary identifier.
+inline int lookupKeyword(const char* s, size_t n) {
+    if (n < KEYWORD_MIN_LEN || n > KEYWORD_MAX_LEN) return 0;
+    const KeywordSlot& k = keywordTable.slot[keywordHash(s, n)];
+    return k.len == n && memcmp(k.name, s, n) == 0 ? k.syn : 0;
+}
+
 // Operators and delimiters
 string operators[] = {"=", "+", "-", "*", "/", "<", "<=", ">", ">=", "!=", "," , ";", ":", "{", "}", "[", "]", "(", ")"};
 
-// Helper functions
-bool isDelimiter(char c) {
-    string delims = ",;:{}[]()";
-    return delims.find(c) != string::npos;
+// Character classes: every byte maps to exactly one class.
+enum CharClass : uint8_t {
+    CC_OTHER,   // not part of the language
+    CC_SPACE,   // isspace() in the C locale
+    CC_ALPHA,   // letters and '_'
+    CC_DIGIT,
+    CC_EQ,      // '='
+    CC_CMP,     // '<' '>' '!' (may be followed by '=')
+    CC_ARITH,   // '+' '-'
+    CC_STAR,    // '*'
+    CC_SLASH,   // '/'
+    CC_DELIM,   // , ; : { } [ ] ( )
+    CC_COUNT
+};
+
+// Scanner DFA states. Every token starts in S_START; the state the DFA
+// stops in decides what was recognised.
+enum ScanState : uint8_t {
+    S_START,
+    S_SPACE,
+    S_IDENT,
+    S_NUMBER,
+    S_CMP,            // '<' '>' '=' '!'
+    S_CMP_EQ,         // "<=" ">=" "==" "!="
+    S_ARITH,          // '+' '-' '*'
+    S_SLASH,          // '/'
+    S_LINE_COMMENT,   // "//" (body skipped by skipComment)
+    S_BLOCK_COMMENT,  // "/*" (body skipped by skipComment)
+    S_DELIM,
+    S_UNKNOWN,
+    S_COUNT,
+    S_STOP = S_COUNT  // no transition: the token ends before this byte
+};
+
+struct ScanTables {
+    uint8_t charClass[256];
+    uint8_t next[S_COUNT][256];  // state x byte, class lookup folded in
+};
+
+constexpr ScanTables buildScanTables() {
+    ScanTables t{};
+    for (int c = 0; c < 256; ++c) {
+        uint8_t cc = CC_OTHER;
+        if (c == ' ' || (c >= '\t' && c <= '\r')) cc = CC_SPACE;
+        else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') cc = CC_ALPHA;
+        else if (c >= '0' && c <= '9') cc = CC_DIGIT;
+        else if (c == '=') cc = CC_EQ;
+        else if (c == '<' || c == '>' || c == '!') cc = CC_CMP;
+        else if (c == '+' || c == '-') cc = CC_ARITH;
+        else if (c == '*') cc = CC_STAR;
+        else if (c == '/') cc = CC_SLASH;
+        else if (c == ',' || c == ';' || c == ':' || c == '{' || c == '}' ||
+                 c == '[' || c == ']' || c == '(' || c == ')') cc = CC_DELIM;
+        t.charClass[c] = cc;
+    }
+
+    uint8_t byClass[S_COUNT][CC_COUNT] = {};
+    for (int s = 0; s < S_COUNT; ++s)
+        for (int cc = 0; cc < CC_COUNT; ++cc)
+            byClass[s][cc] = S_STOP;
+    const uint8_t fromStart[CC_COUNT] = {
+        S_UNKNOWN, S_SPACE, S_IDENT, S_NUMBER, S_CMP, S_CMP, S_ARITH, S_ARITH, S_SLASH, S_DELIM
+    };
+    for (int cc = 0; cc < CC_COUNT; ++cc) byClass[S_START][cc] = fromStart[cc];
+    byClass[S_SPACE][CC_SPACE] = S_SPACE;
+    byClass[S_IDENT][CC_ALPHA] = S_IDENT;
+    byClass[S_IDENT][CC_DIGIT] = S_IDENT;
+    byClass[S_NUMBER][CC_DIGIT] = S_NUMBER;
+    byClass[S_CMP][CC_EQ] = S_CMP_EQ;
+    byClass[S_SLASH][CC_SLASH] = S_LINE_COMMENT;
+    byClass[S_SLASH][CC_STAR] = S_BLOCK_COMMENT;
+
+    for (int s = 0; s < S_COUNT; ++s)
+        for (int c = 0; c < 256; ++c)
+            t.next[s][c] = byClass[s][t.charClass[c]];
+    return t;
+}
+
+constexpr ScanTables scanTables = buildScanTables();
+
+// Run kernels: find the end of a whitespace / identifier / digit run, or the
+// next '\n' / "*/" inside a comment. On x86 the SSE2 and AVX2 versions test
+// 16 or 32 bytes per step and are picked at runtime from the CPU features;
+// everywhere else (and for the last few bytes) the scalar versions walk the
+// DFA table. All versions return the same position.
+struct RunKernels {
+    const char* name;
+    const char* (*spaceRun)(const char* p, const char* end);   // first non-space
+    const char* (*identRun)(const char* p, const char* end);   // first non [A-Za-z0-9_]
+    const char* (*digitRun)(const char* p, const char* end);   // first non-digit
+    const char* (*lineEnd)(const char* p, const char* end);    // first '\n', or end
+    const char* (*blockEnd)(const char* p, const char* end);   // first "*/", or end
+    // Append the offset (from `base`) of every '\n' in [p, end) to `out`.
+    void (*newlines)(const char* base, const char* p, const char* end, vector<uint32_t>& out);
+};
+
+template <uint8_t State>
+const char* runScalar(const char* p, const char* end) {
+    while (p < end && scanTables.next[State][(unsigned char)*p] == State) ++p;
+    return p;
+}
+
+const char* lineEndScalar(const char* p, const char* end) {
+    const void* nl = memchr(p, '\n', end - p);
+    return nl ? static_cast<const char*>(nl) : end;
+}
+
+const char* blockEndScalar(const char* p, const char* end) {
+    for (; end - p >= 2; ++p)
+        if (p[0] == '*' && p[1] == '/') return p;
+    return end;
+}
+
+void newlinesScalar(const char* base, const char* p, const char* end, vector<uint32_t>& out) {
+    for (; (p = lineEndScalar(p, end)) < end; ++p) out.push_back((uint32_t)(p - base));
+}
+
+const RunKernels scalarKernels = {
+    "scalar", runScalar<S_SPACE>, runScalar<S_IDENT>, runScalar<S_NUMBER>,
+    lineEndScalar, blockEndScalar, newlinesScalar
+};
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LEXER_X86_SIMD 1
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+// Byte-wise lo <= v <= hi as an all-ones lane, using unsigned min.
+TARGET_SSE2 inline __m128i inRange16(__m128i v, char lo, char hi) {
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8((char)(hi - lo))), d);
+}
+
+TARGET_AVX2 inline __m256i inRange32(__m256i v, char lo, char hi) {
+    __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8((char)(hi - lo))), d);
+}
+
+// Per-run class tests: bit i of the mask is set when byte i is in the run.
+struct SpaceClass {
+    static const uint8_t state = S_SPACE;
+    TARGET_SSE2 static unsigned mask16(__m128i v) {
+        return (unsigned)_mm_movemask_epi8(_mm_or_si128(
+            inRange16(v, '\t', '\r'), _mm_cmpeq_epi8(v, _mm_set1_epi8(' '))));
+    }
+    TARGET_AVX2 static unsigned mask32(__m256i v) {
+        return (unsigned)_mm256_movemask_epi8(_mm256_or_si256(
+            inRange32(v, '\t', '\r'), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '))));
+    }
+};
+
+struct IdentClass {
+    static const uint8_t state = S_IDENT;
+    TARGET_SSE2 static unsigned mask16(__m128i v) {
+        __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i m = _mm_or_si128(inRange16(lower, 'a', 'z'), inRange16(v, '0', '9'));
+        return (unsigned)_mm_movemask_epi8(_mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('_'))));
+    }
+    TARGET_AVX2 static unsigned mask32(__m256i v) {
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i m = _mm256_or_si256(inRange32(lower, 'a', 'z'), inRange32(v, '0', '9'));
+        return (unsigned)_mm256_movemask_epi8(
+            _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'))));
+    }
+};
+
+struct DigitClass {
+    static const uint8_t state = S_NUMBER;
+    TARGET_SSE2 static unsigned mask16(__m128i v) {
+        return (unsigned)_mm_movemask_epi8(inRange16(v, '0', '9'));
+    }
+    TARGET_AVX2 static unsigned mask32(__m256i v) {
+        return (unsigned)_mm256_movemask_epi8(inRange32(v, '0', '9'));
+    }
+};
+
+template <class Class>
+TARGET_SSE2 const char* runSse2(const char* p, const char* end) {
+    while (end - p >= 16) {
+        unsigned m = Class::mask16(_mm_loadu_si128((const __m128i*)p));
+        if (m != 0xFFFFu) return p + __builtin_ctz(~m);
+        p += 16;
+    }
+    return runScalar<Class::state>(p, end);
+}
+
+template <class Class>
+TARGET_AVX2 const char* runAvx2(const char* p, const char* end) {
+    while (end - p >= 32) {
+        unsigned m = Class::mask32(_mm256_loadu_si256((const __m256i*)p));
+        if (m != 0xFFFFFFFFu) return p + __builtin_ctz(~m);
+        p += 32;
+    }
+    return runScalar<Class::state>(p, end);
+}
+
+TARGET_SSE2 const char* lineEndSse2(const char* p, const char* end) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        unsigned m = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), nl));
+        if (m) return p + __builtin_ctz(m);
+    }
+    return lineEndScalar(p, end);
+}
+
+TARGET_AVX2 const char* lineEndAvx2(const char* p, const char* end) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    for (; end - p >= 32; p += 32) {
+        unsigned m = (unsigned)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), nl));
+        if (m) return p + __builtin_ctz(m);
+    }
+    return lineEndScalar(p, end);
 }
 
-bool isOperatorChar(char c) {
-    string ops = "=+-*/<>!";
-    return ops.find(c) != string::npos;
+// "*/" search: compare the block against '*' and the block shifted by one
+// byte against '/', so a pair straddling two blocks is still found.
+TARGET_SSE2 const char* blockEndSse2(const char* p, const char* end) {
+    const __m128i star = _mm_set1_epi8('*'), slash = _mm_set1_epi8('/');
+    for (; end - p >= 17; p += 16) {
+        __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), star);
+        __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 1)), slash);
+        unsigned m = (unsigned)_mm_movemask_epi8(_mm_and_si128(a, b));
+        if (m) return p + __builtin_ctz(m);
+    }
+    return blockEndScalar(p, end);
 }
 
-bool isKeyword(const string& s) {
-    return keywords.find(s) != keywords.end();
+TARGET_AVX2 const char* blockEndAvx2(const char* p, const char* end) {
+    const __m256i star = _mm256_set1_epi8('*'), slash = _mm256_set1_epi8('/');
+    for (; end - p >= 33; p += 32) {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), star);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 1)), slash);
+        unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(a, b));
+        if (m) return p + __builtin_ctz(m);
+    }
+    return blockEndScalar(p, end);
 }
 
-bool isIdentifierStart(char c) {
-    return isalpha(c) || c == '_';
+// Newline collection: one compare per block, then one entry per set bit.
+TARGET_SSE2 void newlinesSse2(const char* base, const char* p, const char* end, vector<uint32_t>& out) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        unsigned m = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), nl));
+        for (; m; m &= m - 1) out.push_back((uint32_t)(p - base + __builtin_ctz(m)));
+    }
+    newlinesScalar(base, p, end, out);
 }
 
-bool isIdentifierChar(char c) {
-    return isalnum(c) || c == '_';
+TARGET_AVX2 void newlinesAvx2(const char* base, const char* p, const char* end, vector<uint32_t>& out) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    for (; end - p >= 32; p += 32) {
+        unsigned m = (unsigned)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), nl));
+        for (; m; m &= m - 1) out.push_back((uint32_t)(p - base + __builtin_ctz(m)));
+    }
+    newlinesScalar(base, p, end, out);
 }
 
-bool isNumChar(char c) {
-    return isdigit(c);
+const RunKernels sse2Kernels = {
+    "sse2", runSse2<SpaceClass>, runSse2<IdentClass>, runSse2<DigitClass>,
+    lineEndSse2, blockEndSse2, newlinesSse2
+};
+
+const RunKernels avx2Kernels = {
+    "avx2", runAvx2<SpaceClass>, runAvx2<IdentClass>, runAvx2<DigitClass>,
+    lineEndAvx2, blockEndAvx2, newlinesAvx2
+};
+#endif
+
+// Pick the widest kernels the CPU supports ("auto"), or a named set.
+// Returns nullptr for a name this build or CPU cannot provide.
+const RunKernels* selectKernels(const string& mode) {
+#ifdef LEXER_X86_SIMD
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2"), sse2 = __builtin_cpu_supports("sse2");
+    if ((mode == "auto" || mode == "avx2") && avx2) return &avx2Kernels;
+    if ((mode == "auto" || mode == "sse2") && sse2) return &sse2Kernels;
+#endif
+    if (mode == "auto" || mode == "scalar") return &scalarKernels;
+    return nullptr;
 }
 
-void skipComment(ifstream& fin, char first, char next) {
+const RunKernels* runKernels = selectKernels("auto");
+
+// Skip the body of a comment whose opener ("//" or "/*") has been consumed.
+// An unterminated block comment runs to the end of the input.
+void skipComment(const char*& p, const char* end, char first, char next) {
     if (first == '/' && next == '/') {
-        // single line comment
-        char c;
-        while (fin.get(c)) {
-            if (c == '\n') break;
-        }
+        // single line comment, including its '\n'
+        p = runKernels->lineEnd(p, end);
+        if (p < end) ++p;
     } else if (first == '/' && next == '*') {
         // multi-line comment
-        char c, prev = 0;
-        while (fin.get(c)) {
-            if (prev == '*' && c == '/') break;
-            prev = c;
-        }
+        p = runKernels->blockEnd(p, end);
+        p = p < end ? p + 2 : end;
     }
 }
 
-// Main scanning function
-vector<Token> scanTokens(const string& filename) {
-    ifstream fin(filename);
-    if (!fin.is_open()) {
-        cerr << "Error: Cannot open file.\n";
-        exit(1);
+// Eight ASCII digits -> their value, in a few multiply/mask steps (SWAR):
+// adjacent digits are combined pairwise into 2-, 4- and then 8-digit lanes.
+inline uint64_t parseEightDigits(const char* s) {
+    uint64_t w;
+    memcpy(&w, s, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    w = __builtin_bswap64(w);
+#endif
+    w -= 0x3030303030303030ull;
+    w = (w * 10 + (w >> 8)) & 0x00FF00FF00FF00FFull;
+    w = (w * 100 + (w >> 16)) & 0x0000FFFF0000FFFFull;
+    w = (w * 10000 + (w >> 32)) & 0x00000000FFFFFFFFull;
+    return w;
+}
+
+// Value of the digit run s[0..n) without allocating or throwing. Returns
+// false (and INT64_MAX) if the value does not fit in a signed 64-bit int.
+bool parseDigits(const char* s, size_t n, int64_t& out) {
+    while (n > 1 && *s == '0') {  // leading zeros do not count toward the limit
+        ++s;
+        --n;
+    }
+    if (n > 19) {
+        out = INT64_MAX;
+        return false;
+    }
+    uint64_t v = 0;
+    for (; n >= 8; s += 8, n -= 8) v = v * 100000000 + parseEightDigits(s);
+    if (n) {
+        char tail[8] = {'0', '0', '0', '0', '0', '0', '0', '0'};
+        memcpy(tail + 8 - n, s, n);
+        uint64_t scale = 1;
+        for (size_t i = 0; i < n; ++i) scale *= 10;
+        v = v * scale + parseEightDigits(tail);
     }
+    if (v > (uint64_t)INT64_MAX) {  // 19 digits always fit in uint64_t
+        out = INT64_MAX;
+        return false;
+    }
+    out = (int64_t)v;
+    return true;
+}
 
-    vector<Token> tokens;
-    char ch;
-    while (fin.get(ch)) {
-        if (isspace(ch)) continue;
+// Main scanning loop: scans the tokens that start in [p, limit) and appends
+// them to `tokens`. A token or comment that starts before `limit` is
+// finished even if it runs past it (up to `end`); a whitespace run is cut
+// off at `limit`. Returns the position where scanning stopped, which is
+// `limit` unless a token or comment crossed it.
+const char* scanRange(const char* p, const char* limit, const char* end, TokenStream& tokens) {
+    while (p < limit) {
+        // Run the DFA until it has no transition: one table lookup per byte.
+        // Long whitespace, identifier and digit runs are skipped in blocks.
+        const char* start = p;
+        uint8_t state = scanTables.next[S_START][(unsigned char)*p++];
+        if (state == S_SPACE) {
+            p = runKernels->spaceRun(p, limit);
+            continue;
+        }
+        if (state == S_IDENT) p = runKernels->identRun(p, end);
+        else if (state == S_NUMBER) p = runKernels->digitRun(p, end);
+        while (p < end) {
+            uint8_t next = scanTables.next[state][(unsigned char)*p];
+            if (next == S_STOP) break;
+            state = next;
+            ++p;
+        }
 
-        // Handle identifiers and keywords
-        if (isIdentifierStart(ch)) {
-            string word;
-            word += ch;
-            while (fin.peek() != EOF && isIdentifierChar(fin.peek())) {
-                word += fin.get();
-            }
-            Token t;
-            if (isKeyword(word)) {
-                t.syn = keywords[word];
-                t.token = word;
-                t.sum = -1;
+        switch (state) {
+        case S_IDENT: {
+            // Handle identifiers and keywords
+            int syn = lookupKeyword(start, p - start);
+            if (syn) {
+                tokens.push(syn, start, p - start, -1);
             } else {
-                t.syn = 100;  // Identifier code
-                t.token = word;
-                t.sum = -1;
+                tokens.pushIdentifier(start, p - start);
             }
-            tokens.push_back(t);
+            break;
         }
-
-        // Handle numbers
-        else if (isNumChar(ch)) {
-            string num;
-            num += ch;
-            while (fin.peek() != EOF && isNumChar(fin.peek())) {
-                num += fin.get();
-            }
-            Token t;
-            t.syn = 101;  // Number code
-            t.token = num;
-            t.sum = stoi(num);
-            tokens.push_back(t);
-        }
-
-        // Handle comments and operators
-        else if (isOperatorChar(ch)) {
-            char next = fin.peek();
-            if (ch == '/' && (next == '/' || next == '*')) {
-                fin.get(); // consume next
-                skipComment(fin, ch, next);
-                continue;
-            }
-            string op(1, ch);
-            if ((ch == '<' || ch == '>' || ch == '=' || ch == '!') && next == '=') {
-                op += fin.get(); // consume '='
-            }
-            Token t;
-            t.syn = 200; // Operator code
-            t.token = op;
-            t.sum = -1;
-            tokens.push_back(t);
+        case S_NUMBER: {
+            int64_t v;
+            bool ok = parseDigits(start, p - start, v);
+            tokens.push(101, start, p - start, v, ok ? 0 : TOKEN_OVERFLOW);  // Number code
+            break;
+        }
+        case S_LINE_COMMENT:
+            skipComment(p, end, '/', '/');
+            break;
+        case S_BLOCK_COMMENT:
+            skipComment(p, end, '/', '*');
+            break;
+        case S_CMP:
+        case S_CMP_EQ:
+        case S_ARITH:
+        case S_SLASH:
+            tokens.push(200, start, p - start, -1); // Operator code
+            break;
+        case S_DELIM:
+            tokens.push(300, start, 1, -1); // Delimiter code
+            break;
+        case S_UNKNOWN:
+            tokens.unknown.push_back((uint32_t)(start - tokens.base));
+            break;
+        default:  // whitespace
+            break;
         }
+    }
+    return p;
+}
+
+void checkInputSize(const char* begin, const char* end) {
+    if ((size_t)(end - begin) > UINT32_MAX) {
+        cerr << "Error: Input larger than 4 GiB is not supported.\n";
+        exit(1);
+    }
+}
 
-        // Handle delimiters
-        else if (isDelimiter(ch)) {
-            Token t;
-            t.syn = 300; // Delimiter code
-            t.token = string(1, ch);
-            t.sum = -1;
-            tokens.push_back(t);
+// Scan [begin, end) without copying any lexeme.
+// The stream points into the buffer, so it must outlive the stream.
+TokenStream scanTokens(const char* begin, const char* end) {
+    checkInputSize(begin, end);
+    TokenStream tokens;
+    tokens.base = begin;
+    // Typical sources average well over four bytes per token; the arrays
+    // still grow if a denser input exceeds the estimate.
+    tokens.reserve((size_t)(end - begin) / 4 + 16);
+    scanRange(begin, end, end, tokens);
+    return tokens;
+}
+
+// Parallel scan: the input is cut into chunks at line starts, the chunks are
+// scanned on `threads` worker threads, and the per-chunk streams are joined
+// in order. A line start is a safe boundary unless a block comment spans it;
+// that shows up as the previous chunk stopping past the boundary, and the
+// affected chunk is then rescanned from the true position. The result is
+// identical to scanTokens().
+TokenStream scanTokensParallel(const char* begin, const char* end, unsigned threads,
+                               size_t minChunk = 1 << 20) {
+    checkInputSize(begin, end);
+    size_t size = end - begin;
+    if (threads < 1) threads = 1;
+    size_t chunkCount = min<size_t>(threads * 4, size / max<size_t>(minChunk, 1));
+    if (chunkCount < 2) return scanTokens(begin, end);
+
+    // Speculative pre-pass: move each nominal cut forward to the next line
+    // start. Cuts that collide (very long lines) are merged away.
+    vector<const char*> cuts{begin};
+    for (size_t i = 1; i < chunkCount; ++i) {
+        const char* nominal = begin + size / chunkCount * i;
+        if (nominal <= cuts.back()) continue;
+        const char* nl = runKernels->lineEnd(nominal, end);
+        if (nl + 1 < end && nl + 1 > cuts.back()) cuts.push_back(nl + 1);
+    }
+    cuts.push_back(end);
+    size_t chunks = cuts.size() - 1;
+
+    struct Chunk {
+        TokenStream tokens;
+        const char* stop = nullptr;
+    };
+    vector<Chunk> parts(chunks);
+    atomic<size_t> nextChunk{0};
+    auto worker = [&]() {
+        for (size_t i; (i = nextChunk.fetch_add(1)) < chunks;) {
+            Chunk& c = parts[i];
+            c.tokens.base = begin;
+            c.tokens.reserve((size_t)(cuts[i + 1] - cuts[i]) / 4 + 16);
+            c.stop = scanRange(cuts[i], cuts[i + 1], end, c.tokens);
         }
+    };
+    vector<thread> pool;
+    for (unsigned t = 1; t < min<size_t>(threads, chunks); ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
 
-        // Unknown characters
-        else {
-            cout << "Warning: Unknown symbol '" << ch << "' ignored.\n";
+    // Fix-up: walk the chunks in order and rescan any chunk whose
+    // speculative start does not match where the previous one stopped.
+    const char* pos = begin;
+    size_t total = 0;
+    for (size_t i = 0; i < chunks; ++i) {
+        Chunk& c = parts[i];
+        if (cuts[i] != pos) {
+            c.tokens = TokenStream();
+            c.tokens.base = begin;
+            c.stop = pos < cuts[i + 1] ? scanRange(pos, cuts[i + 1], end, c.tokens) : pos;
         }
+        pos = c.stop;
+        total += c.tokens.size();
     }
 
-    fin.close();
+    TokenStream tokens;
+    tokens.base = begin;
+    tokens.reserve(total);
+    for (Chunk& c : parts) tokens.append(c.tokens);
     return tokens;
 }
 
+TokenStream scanTokens(const SourceBuffer& src, unsigned threads = 1, size_t minChunk = 1 << 20) {
+    if (threads > 1) return scanTokensParallel(src.begin(), src.end(), threads, minChunk);
+    return scanTokens(src.begin(), src.end());
+}
+
+// Newline index for on-demand positions. Tokens carry only a byte offset;
+// the offsets of all '\n' bytes are collected once per text (on first use)
+// and line/column of any offset is then a binary search away, so scanning
+// pays nothing for positions.
+class LineIndex {
+public:
+    struct Position {
+        size_t line;    // 1-based
+        size_t column;  // 1-based, in bytes
+    };
+
+    LineIndex(const char* begin, const char* end) {
+        newlines.reserve((size_t)(end - begin) / 32 + 16);
+        runKernels->newlines(begin, begin, end, newlines);
+    }
+
+    Position resolve(size_t offset) const {
+        size_t before = lower_bound(newlines.begin(), newlines.end(), (uint32_t)offset) - newlines.begin();
+        size_t lineStart = before ? newlines[before - 1] + 1 : 0;
+        return Position{before + 1, offset - lineStart + 1};
+    }
+
+    size_t lines() const { return newlines.size() + 1; }
+
+private:
+    vector<uint32_t> newlines;  // offsets of '\n', ascending
+};
+
+// An edit to scanned text: `removed` bytes at `offset` were replaced by
+// `inserted` bytes.
+struct TextEdit {
+    size_t offset;
+    size_t removed;
+    size_t inserted;
+};
+
+// Incremental re-scan after an edit. `begin`/`end` is the new text with the
+// edit already applied, and `tokens` is the stream of the text before it.
+// Scanning restarts right after the last token that ends before the edit
+// (the scanner is always in its start state there) and proceeds in growing
+// windows until a new token starts at the shifted position of an old token
+// past the edit; from there on both scans are identical, so the old tail is
+// kept and only its offsets are shifted. Returns the number of bytes
+// rescanned, which is proportional to the edit rather than to the file.
+size_t relexTokens(TokenStream& tokens, const char* begin, const char* end, const TextEdit& edit) {
+    checkInputSize(begin, end);
+    size_t editEnd = edit.offset + edit.inserted;      // end of the edit, new text
+    size_t oldEditEnd = edit.offset + edit.removed;    // end of the edit, old text
+    if (editEnd > (size_t)(end - begin)) {
+        cerr << "Error: Edit lies outside the text.\n";
+        exit(1);
+    }
+
+    // Tokens [0, keep) end strictly before the edit and stay as they are.
+    // Token ends are increasing, so this is a binary search.
+    size_t lo = 0, hi = tokens.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (tokens.offset[mid] + tokens.length[mid] < edit.offset) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t keep = lo;
+    size_t restart = keep ? tokens.offset[keep - 1] + tokens.length[keep - 1] : 0;
+
+    // First old token that starts after the edit: candidates for resync.
+    size_t old = keep;
+    while (old < tokens.size() && tokens.offset[old] < oldEditEnd) ++old;
+
+    TokenStream fresh;
+    fresh.base = begin;
+    const char* p = begin + restart;
+    size_t resyncNew = SIZE_MAX;   // index in `fresh` where the old tail takes over
+    for (size_t window = 256; p < end && resyncNew == SIZE_MAX; window *= 2) {
+        size_t first = fresh.size();
+        const char* limit = end - p > (ptrdiff_t)window ? p + window : end;
+        p = scanRange(p, limit, end, fresh);
+        for (size_t i = first; i < fresh.size() && resyncNew == SIZE_MAX; ++i) {
+            if (fresh.offset[i] < editEnd) continue;
+            size_t oldOffset = fresh.offset[i] - edit.inserted + edit.removed;
+            while (old < tokens.size() && tokens.offset[old] < oldOffset) ++old;
+            if (old < tokens.size() && tokens.offset[old] == oldOffset) resyncNew = i;
+        }
+    }
+    if (resyncNew == SIZE_MAX) {
+        resyncNew = fresh.size();
+        old = tokens.size();
+    }
+    size_t resyncOffset = resyncNew < fresh.size() ? fresh.offset[resyncNew] : end - begin;
+    size_t oldResyncOffset = old < tokens.size() ? tokens.offset[old] : resyncOffset - edit.inserted + edit.removed;
+
+    // Splice: tokens[keep, old) are replaced by fresh[0, resyncNew).
+    vector<uint32_t> remap(fresh.symbols.size());
+    for (uint32_t id = 0; id < remap.size(); ++id)
+        remap[id] = tokens.symbols.intern(fresh.symbols.name(id));
+    for (size_t i = 0; i < resyncNew; ++i)
+        if (fresh.kind[i] == 100) fresh.value[i] = remap[fresh.value[i]];
+    auto splice = [&](auto& dst, const auto& src) {
+        dst.erase(dst.begin() + keep, dst.begin() + old);
+        dst.insert(dst.begin() + keep, src.begin(), src.begin() + resyncNew);
+    };
+    splice(tokens.kind, fresh.kind);
+    splice(tokens.offset, fresh.offset);
+    splice(tokens.length, fresh.length);
+    splice(tokens.value, fresh.value);
+    splice(tokens.flags, fresh.flags);
+
+    // Shift the offsets of the kept tail.
+    int64_t delta = (int64_t)edit.inserted - (int64_t)edit.removed;
+    for (size_t i = keep + resyncNew; i < tokens.size(); ++i)
+        tokens.offset[i] = (uint32_t)(tokens.offset[i] + delta);
+
+    // Unknown symbols: drop the rescanned range, add the fresh ones, shift the rest.
+    vector<uint32_t> unknown;
+    for (uint32_t u : tokens.unknown)
+        if (u < restart) unknown.push_back(u);
+    for (uint32_t u : fresh.unknown)
+        if (u < resyncOffset) unknown.push_back(u);
+    for (uint32_t u : tokens.unknown)
+        if (u >= oldResyncOffset) unknown.push_back((uint32_t)(u + delta));
+    tokens.unknown.swap(unknown);
+
+    tokens.base = begin;
+    return resyncOffset - restart;
+}
+
+// Micro-benchmark: perfect-hash keyword lookup against the std::map lookup
+// the scanner used before (isKeyword() followed by keywords[word]).
+// Words come from the identifiers and keywords of `tokens` when given,
+// otherwise from a built-in mix of keywords and near-miss identifiers.
+void benchKeywords(const TokenStream* tokens) {
+    vector<string> words;
+    if (tokens) {
+        for (size_t i = 0; i < tokens->size(); ++i)
+            if (tokens->kind[i] <= 27 || tokens->kind[i] == 100)
+                words.push_back(string(tokens->text(i)));
+    }
+    if (words.empty()) {
+        for (const Keyword& k : keywords) words.push_back(k.name);
+        for (const char* w : {"x", "i", "count", "whilex", "integer1", "mainLoop", "wr",
+                              "reader", "total", "_tmp", "toX", "ofs", "value", "swap"})
+            words.push_back(w);
+    }
+
+    map<string, int> table;
+    for (const Keyword& k : keywords) table[k.name] = k.syn;
+
+    const size_t lookups = 20000000;
+    size_t rounds = lookups / words.size() + 1;
+    using clock = chrono::steady_clock;
+
+    long long mapSum = 0;
+    auto t0 = clock::now();
+    for (size_t r = 0; r < rounds; ++r)
+        for (const string& w : words)
+            if (table.find(w) != table.end()) mapSum += table[w];
+    auto t1 = clock::now();
+
+    long long hashSum = 0;
+    for (size_t r = 0; r < rounds; ++r)
+        for (const string& w : words)
+            hashSum += lookupKeyword(w.data(), w.size());
+    auto t2 = clock::now();
+
+    double n = (double)rounds * words.size();
+    double mapNs = chrono::duration<double, nano>(t1 - t0).count() / n;
+    double hashNs = chrono::duration<double, nano>(t2 - t1).count() / n;
+    cout << "Keyword lookup over " << words.size() << " words, " << (long long)n << " lookups\n";
+    cout << "  std::map      : " << mapNs << " ns/lookup\n";
+    cout << "  perfect hash  : " << hashNs << " ns/lookup\n";
+    cout << "  speedup       : " << mapNs / hashNs << "x\n";
+    if (mapSum != hashSum) {
+        cerr << "Error: map and perfect hash disagree.\n";
+        exit(1);
+    }
+}
+
+// Output sink: tokens are formatted into one large buffer that is written
+// with a single fwrite whenever it fills up, instead of several ostream
+// insertions per token.
+class OutputBuffer {
+public:
+    explicit OutputBuffer(FILE* out, size_t capacity = 1 << 20) : out(out), buf(capacity) {}
+    ~OutputBuffer() { flush(); }
+
+    void write(const void* data, size_t n) {
+        if (used + n > buf.size()) {
+            flush();
+            if (n > buf.size()) {
+                fwrite(data, 1, n, out);
+                return;
+            }
+        }
+        memcpy(buf.data() + used, data, n);
+        used += n;
+    }
+    void write(string_view s) { write(s.data(), s.size()); }
+    void write(long long v) {
+        char tmp[24];
+        auto res = to_chars(tmp, tmp + sizeof(tmp), v);
+        write(tmp, res.ptr - tmp);
+    }
+    void flush() {
+        if (used) fwrite(buf.data(), 1, used, out);
+        used = 0;
+    }
+
+private:
+    FILE* out;
+    vector<char> buf;
+    size_t used = 0;
+};
+
+// Binary token format ("--format=binary"): a header followed by one
+// fixed-size record per token, in host byte order. Offsets and lengths
+// refer to the bytes of the input file. Version 2: for identifiers the
+// value field holds the symbol id instead of -1. Version 3: 64-bit value
+// and a flags field.
+struct BinaryTokenHeader {
+    char magic[4];       // "LXTK"
+    uint32_t version;    // 3
+    uint64_t count;      // number of records that follow
+};
+
+struct BinaryTokenRecord {
+    uint32_t kind;       // syn code
+    uint32_t offset;
+    uint32_t length;
+    uint32_t flags;      // TOKEN_OVERFLOW
+    int64_t value;       // sum, or symbol id for identifiers
+};
+
+// `lines` is optional; when given, each token also gets its line:column.
+void writeText(const TokenStream& tokens, OutputBuffer& out, const LineIndex* lines = nullptr) {
+    out.write("\n=========== TOKEN SEQUENCE ===========\n");
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        out.write("<syn:");
+        out.write((long long)tokens.kind[i]);
+        out.write(", token:'");
+        out.write(tokens.text(i));
+        out.write("', sum:");
+        if (tokens.overflow(i)) out.write("overflow");
+        else out.write((long long)tokens.sum(i));
+        if (lines) {
+            LineIndex::Position pos = lines->resolve(tokens.offset[i]);
+            out.write(", at:");
+            out.write((long long)pos.line);
+            out.write(":");
+            out.write((long long)pos.column);
+        }
+        out.write(">\n");
+    }
+    out.write("=====================================\n");
+}
+
+void writeBinary(const TokenStream& tokens, OutputBuffer& out) {
+    BinaryTokenHeader h = {{'L', 'X', 'T', 'K'}, 3, tokens.size()};
+    out.write(&h, sizeof(h));
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        BinaryTokenRecord r = {tokens.kind[i], tokens.offset[i], tokens.length[i],
+                               tokens.flags[i], tokens.value[i]};
+        out.write(&r, sizeof(r));
+    }
+}
+
+void printUsage() {
+    cout << "Usage: lexer [options] <sourcefile>   (\"-\" reads standard input)\n"
+            "  --bench-keywords   time keyword lookup (map vs perfect hash) and exit;\n"
+            "                     uses the words of <sourcefile> when one is given\n"
+            "  --stats            report scan time and throughput on stderr\n"
+            "  --simd=MODE        run kernels: auto (default), avx2, sse2 or scalar\n"
+            "  --threads=N        scan in parallel on N threads (0 = all cores)\n"
+            "  --chunk=BYTES      minimum chunk size for --threads (default 1 MiB)\n"
+            "  --format=FMT       token output: text (default) or binary\n"
+            "  --quiet            print only the token count\n"
+            "  --positions        add line:column to each token in text output\n"
+            "  --edit=OFF,DEL,TEXT  replace DEL bytes at OFF with TEXT, then re-scan\n"
+            "                     incrementally and print the updated stream\n";
+}
+
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        cout << "Usage: lexer <sourcefile>\n";
+    string filename;
+    bool benchKw = false;
+    bool stats = false;
+    unsigned threads = 1;
+    size_t minChunk = 1 << 20;
+    string format = "text";
+    bool quiet = false;
+    bool hasEdit = false;
+    bool positions = false;
+    size_t editOffset = 0, editRemoved = 0;
+    string editText;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--bench-keywords") {
+            benchKw = true;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg.rfind("--simd=", 0) == 0) {
+            runKernels = selectKernels(arg.substr(7));
+            if (!runKernels) {
+                cerr << "Error: SIMD mode '" << arg.substr(7) << "' is not available.\n";
+                return 1;
+            }
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            threads = (unsigned)strtoul(arg.c_str() + 10, nullptr, 10);
+            if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+        } else if (arg.rfind("--chunk=", 0) == 0) {
+            minChunk = strtoull(arg.c_str() + 8, nullptr, 10);
+        } else if (arg == "--format=text" || arg == "--format=binary") {
+            format = arg.substr(9);
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else if (arg == "--positions") {
+            positions = true;
+        } else if (arg.rfind("--edit=", 0) == 0) {
+            size_t c1 = arg.find(',', 7), c2 = c1 == string::npos ? c1 : arg.find(',', c1 + 1);
+            if (c2 == string::npos) {
+                printUsage();
+                return 1;
+            }
+            hasEdit = true;
+            editOffset = strtoull(arg.c_str() + 7, nullptr, 10);
+            editRemoved = strtoull(arg.c_str() + c1 + 1, nullptr, 10);
+            editText = arg.substr(c2 + 1);
+        } else if (arg.size() > 2 && arg[0] == '-' && arg[1] == '-') {
+            printUsage();
+            return 1;
+        } else {
+            filename = arg;
+        }
+    }
+
+    if (benchKw) {
+        if (filename.empty()) {
+            benchKeywords(nullptr);
+        } else {
+            SourceBuffer src(filename);
+            TokenStream tokens = scanTokens(src);
+            benchKeywords(&tokens);
+        }
+        return 0;
+    }
+    if (filename.empty()) {
+        printUsage();
         return 1;
     }
 
-    vector<Token> tokens = scanTokens(argv[1]);
-    cout << "\n=========== TOKEN SEQUENCE ===========\n";
-    for (auto &t : tokens) {
-        cout << "<syn:" << t.syn << ", token:'" << t.token << "', sum:" << t.sum << ">\n";
+    SourceBuffer src(filename);
+    auto t0 = chrono::steady_clock::now();
+    TokenStream tokens = scanTokens(src, threads, minChunk);
+    auto t1 = chrono::steady_clock::now();
+    if (stats) {
+        double sec = chrono::duration<double>(t1 - t0).count();
+        cerr << "Scanned " << src.size() << " bytes, " << tokens.size() << " tokens in "
+             << sec * 1000 << " ms (" << src.size() / 1e6 / sec << " MB/s, "
+             << runKernels->name << " kernels, " << threads << " thread(s)), "
+             << tokens.symbols.size() << " distinct identifiers\n";
+    }
+
+    string edited;
+    if (hasEdit) {
+        if (editOffset > src.size() || editRemoved > src.size() - editOffset) {
+            cerr << "Error: Edit lies outside the text.\n";
+            return 1;
+        }
+        edited.assign(src.begin(), src.size());
+        edited.replace(editOffset, editRemoved, editText);
+        auto e0 = chrono::steady_clock::now();
+        size_t rescanned = relexTokens(tokens, edited.data(), edited.data() + edited.size(),
+                                       TextEdit{editOffset, editRemoved, editText.size()});
+        auto e1 = chrono::steady_clock::now();
+        if (stats) {
+            cerr << "Re-scanned " << rescanned << " bytes after the edit in "
+                 << chrono::duration<double>(e1 - e0).count() * 1000 << " ms\n";
+        }
+    }
+
+    // Line/column are only worked out when something needs them.
+    const char* textEnd = hasEdit ? edited.data() + edited.size() : src.end();
+    unique_ptr<LineIndex> lines;
+    if (positions || !tokens.unknown.empty()) lines.reset(new LineIndex(tokens.base, textEnd));
+    for (uint32_t off : tokens.unknown) {
+        LineIndex::Position pos = lines->resolve(off);
+        cerr << "Warning: Unknown symbol '" << tokens.base[off] << "' ignored (line "
+             << pos.line << ", column " << pos.column << ").\n";
+    }
+
+    if (quiet) {
+        cout << tokens.size() << " tokens\n";
+        return 0;
     }
-    cout << "=====================================\n";
+#ifdef _WIN32
+    if (format == "binary") _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    OutputBuffer out(stdout);
+    if (format == "binary") writeBinary(tokens, out);
+    else writeText(tokens, out, positions ? lines.get() : nullptr);
     return 0;
 }
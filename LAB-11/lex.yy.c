@@ -476,10 +476,20 @@ char *yytext;
 #line 1 "lexer.l"
 #line 2 "lexer.l"
 #include "parser.tab.h"
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#line 481 "lex.yy.c"
-#line 482 "lex.yy.c"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* token text is a slice of the input buffer, see scanInput() */
+#define TEXT() (yylval.txt.p = yytext, yylval.txt.len = (int)yyleng)
+#line 491 "lex.yy.c"
+#line 492 "lex.yy.c"
 
 #define INITIAL 0
 
@@ -696,10 +706,10 @@ YY_DECL
 		}
 
 	{
-#line 7 "lexer.l"
+#line 17 "lexer.l"
 
 
-#line 702 "lex.yy.c"
+#line 712 "lex.yy.c"
 
 	while ( /*CONSTCOND*/1 )		/* loops until end-of-file is reached */
 		{
@@ -758,144 +768,144 @@ do_action:	/* This label is used only to access EOF actions. */
 
 case 1:
 YY_RULE_SETUP
-#line 9 "lexer.l"
+#line 19 "lexer.l"
 { return INT; }
 	YY_BREAK
 case 2:
 YY_RULE_SETUP
-#line 10 "lexer.l"
+#line 20 "lexer.l"
 { return FLOAT; }
 	YY_BREAK
 case 3:
 YY_RULE_SETUP
-#line 11 "lexer.l"
+#line 21 "lexer.l"
 { return IF; }
 	YY_BREAK
 case 4:
 YY_RULE_SETUP
-#line 12 "lexer.l"
+#line 22 "lexer.l"
 { return THEN; }
 	YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 13 "lexer.l"
+#line 23 "lexer.l"
 { return ELSE; }
 	YY_BREAK
 case 6:
 YY_RULE_SETUP
-#line 14 "lexer.l"
+#line 24 "lexer.l"
 { return WHILE; }
 	YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 15 "lexer.l"
+#line 25 "lexer.l"
 { return DO; }
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 17 "lexer.l"
-{ yylval.str = strdup(yytext); return ROP; }
+#line 27 "lexer.l"
+{ TEXT(); return ROP; }
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
-#line 18 "lexer.l"
-{ yylval.str = strdup(yytext); return ROP; }
+#line 28 "lexer.l"
+{ TEXT(); return ROP; }
 	YY_BREAK
 case 10:
 YY_RULE_SETUP
-#line 19 "lexer.l"
-{ yylval.str = strdup(yytext); return ROP; }
+#line 29 "lexer.l"
+{ TEXT(); return ROP; }
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 20 "lexer.l"
-{ yylval.str = strdup(yytext); return ROP; }
+#line 30 "lexer.l"
+{ TEXT(); return ROP; }
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 21 "lexer.l"
-{ yylval.str = strdup(yytext); return ROP; }
+#line 31 "lexer.l"
+{ TEXT(); return ROP; }
 	YY_BREAK
 case 13:
 YY_RULE_SETUP
-#line 22 "lexer.l"
-{ yylval.str = strdup(yytext); return ROP; }
+#line 32 "lexer.l"
+{ TEXT(); return ROP; }
 	YY_BREAK
 case 14:
 YY_RULE_SETUP
-#line 24 "lexer.l"
+#line 34 "lexer.l"
 { return LBRACE; }
 	YY_BREAK
 case 15:
 YY_RULE_SETUP
-#line 25 "lexer.l"
+#line 35 "lexer.l"
 { return RBRACE; }
 	YY_BREAK
 case 16:
 YY_RULE_SETUP
-#line 26 "lexer.l"
+#line 36 "lexer.l"
 { return SEMI; }
 	YY_BREAK
 case 17:
 YY_RULE_SETUP
-#line 27 "lexer.l"
+#line 37 "lexer.l"
 { return COMMA; }
 	YY_BREAK
 case 18:
 YY_RULE_SETUP
-#line 28 "lexer.l"
+#line 38 "lexer.l"
 { return ASSIGN; }
 	YY_BREAK
 case 19:
 YY_RULE_SETUP
-#line 29 "lexer.l"
+#line 39 "lexer.l"
 { return LPAREN; }
 	YY_BREAK
 case 20:
 YY_RULE_SETUP
-#line 30 "lexer.l"
+#line 40 "lexer.l"
 { return RPAREN; }
 	YY_BREAK
 case 21:
 YY_RULE_SETUP
-#line 31 "lexer.l"
+#line 41 "lexer.l"
 { return PLUS; }
 	YY_BREAK
 case 22:
 YY_RULE_SETUP
-#line 32 "lexer.l"
+#line 42 "lexer.l"
 { return TIMES; }
 	YY_BREAK
 case 23:
 YY_RULE_SETUP
-#line 34 "lexer.l"
-{ yylval.str = strdup(yytext); return NUM; }
+#line 44 "lexer.l"
+{ TEXT(); return NUM; }
 	YY_BREAK
 case 24:
 YY_RULE_SETUP
-#line 36 "lexer.l"
+#line 46 "lexer.l"
 {
-               yylval.str = strdup(yytext);
+               TEXT();
                return ID;
            }
 	YY_BREAK
 case 25:
 /* rule 25 can match eol */
 YY_RULE_SETUP
-#line 41 "lexer.l"
+#line 51 "lexer.l"
 { /* skip whitespace */ }
 	YY_BREAK
 case 26:
 YY_RULE_SETUP
-#line 43 "lexer.l"
+#line 53 "lexer.l"
 { /* ignore unknown char */ }
 	YY_BREAK
 case 27:
 YY_RULE_SETUP
-#line 45 "lexer.l"
+#line 55 "lexer.l"
 ECHO;
 	YY_BREAK
-#line 898 "lex.yy.c"
+#line 908 "lex.yy.c"
 case YY_STATE_EOF(INITIAL):
 	yyterminate();
 
@@ -1900,8 +1910,62 @@ void yyfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 45 "lexer.l"
+#line 55 "lexer.l"
 
 
 int yywrap(void) { return 1; }
 
+/* Load the whole input and scan it in place with yy_scan_buffer, so
+   yytext always points into one buffer that outlives the parse.
+   flex needs two NUL bytes after the text: a file is mapped over a
+   zeroed anonymous reservation of size + 2 bytes, so the sentinels are
+   the zero tail of its last page or the anonymous page after it. The
+   mapping is private and writable because flex writes a NUL after each
+   token. stdin, pipes and empty files are read into memory instead.
+   The buffer is never released: the parser's texts point into it. */
+int scanInput(const char *path) {
+    char *buf;
+    size_t n = 0;
+#ifndef _WIN32
+    if (path) {
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return 1;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            size_t len = ((size_t)st.st_size + 2 + page - 1) / page * page;
+            buf = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (buf != MAP_FAILED) {
+                if (mmap(buf, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+                    close(fd);
+                    yy_scan_buffer(buf, (size_t)st.st_size + 2);
+                    return 0;
+                }
+                munmap(buf, len);
+            }
+        }
+        close(fd);
+    }
+#endif
+    FILE *f = path ? fopen(path, "rb") : stdin;
+    if (!f) return 1;
+    size_t cap = 1 << 16, got;
+    buf = malloc(cap + 2);
+    while (buf && (got = fread(buf + n, 1, cap - n, f)) > 0) {
+        n += got;
+        if (n == cap) {
+            cap *= 2;
+            char *grown = realloc(buf, cap + 2);
+            if (!grown) free(buf);
+            buf = grown;
+        }
+    }
+    if (f != stdin) fclose(f);
+    if (!buf) return 1;
+    buf[n] = buf[n + 1] = 0;
+    yy_scan_buffer(buf, n + 2);
+    return 0;
+}
+
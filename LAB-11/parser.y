@@ -1,3 +1,20 @@
+/* IDs, NUMs and ROPs point straight into the scanner's input buffer,
+   which stays in memory for the whole parse, so they are passed as a
+   pointer and a length instead of a strdup'd copy. */
+%code requires {
+struct text {
+    const char *p;   /* not NUL-terminated */
+    int len;
+};
+}
+
+/* %union comes before the %{ %} block so that block is emitted after
+   YYSTYPE and can use struct text. */
+%union {
+    struct text txt;   /* for IDs, NUMs, temporaries */
+    int   num;         /* for instruction indices (M, N) */
+}
+
 %{
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,17 +32,33 @@ int symcount = 0;
 
 char curType[16];        /* current declaration type: "int" or "float" */
 
-int lookup(char *name) {
+/* Build a text slice from a C string (NULL gives an empty slice). */
+struct text mkText(const char *s) {
+    struct text t;
+    t.p = s;
+    t.len = s ? (int)strlen(s) : 0;
+    return t;
+}
+
+/* Copy a text slice into a fixed-size, NUL-terminated field. */
+void copyText(char *dst, size_t size, struct text t) {
+    size_t n = (size_t)t.len < size ? (size_t)t.len : size - 1;
+    if (n) memcpy(dst, t.p, n);
+    dst[n] = '\0';
+}
+
+int lookup(struct text name) {
     for (int i = 0; i < symcount; i++) {
-        if (strcmp(symtab[i].name, name) == 0)
+        if (strncmp(symtab[i].name, name.p, name.len) == 0 &&
+            symtab[i].name[name.len] == '\0')
             return i;
     }
     return -1;
 }
 
-void addSymbol(char *name, char *type) {
+void addSymbol(struct text name, char *type) {
     if (lookup(name) != -1) return;  /* already exists */
-    strcpy(symtab[symcount].name, name);
+    copyText(symtab[symcount].name, sizeof symtab[symcount].name, name);
     strcpy(symtab[symcount].type, type);
     symcount++;
 }
@@ -51,45 +84,41 @@ int qc = 0;   /* count of quads */
 
 int nextInstr(void) { return qc; }
 
-void emit(const char *op, const char *a1, const char *a2, const char *res) {
-    strcpy(quads[qc].op,    op  ? op  : "");
-    strcpy(quads[qc].arg1,  a1  ? a1  : "");
-    strcpy(quads[qc].arg2,  a2  ? a2  : "");
-    strcpy(quads[qc].result,res ? res : "");
+void emit(struct text op, struct text a1, struct text a2, struct text res) {
+    copyText(quads[qc].op,     sizeof quads[qc].op,     op);
+    copyText(quads[qc].arg1,   sizeof quads[qc].arg1,   a1);
+    copyText(quads[qc].arg2,   sizeof quads[qc].arg2,   a2);
+    copyText(quads[qc].result, sizeof quads[qc].result, res);
     qc++;
 }
 
 int tempCount = 0;
-char *newTemp(void) {
+struct text newTemp(void) {
     char buf[32];
     sprintf(buf, "t%d", tempCount++);
     char *p = (char*)malloc(strlen(buf) + 1);
     strcpy(p, buf);
-    return p;
+    return mkText(p);
 }
 
 /* we’ll keep the last expression’s result here, for while conditions */
-char *lastExprTemp = NULL;
+struct text lastExprTemp = { NULL, 0 };
 
 /* ---------- declarations for bison ---------- */
 
 int yylex(void);
 void yyerror(const char *s);
+int scanInput(const char *path);
 %}
 
 /* ---------- Bison definitions ---------- */
 
-%union {
-    char *str;   /* for IDs, NUMs, temporaries */
-    int   num;   /* for instruction indices (M, N) */
-}
-
 %token INT FLOAT IF THEN ELSE WHILE DO
-%token <str> ID NUM
-%token <str> ROP
+%token <txt> ID NUM
+%token <txt> ROP
 %token LBRACE RBRACE SEMI COMMA ASSIGN LPAREN RPAREN PLUS TIMES
 
-%type <str> E
+%type <txt> E
 %type <num> M N
 
 %%
@@ -143,7 +172,7 @@ StmtList
 Stmt
     : ID ASSIGN E SEMI               /* assignment */
       {
-          emit("=", $3, "-", $1);
+          emit(mkText("="), $3, mkText("-"), $1);
       }
     | WHILE M LPAREN E RPAREN N Stmt /* while(E) S */
       {
@@ -154,7 +183,7 @@ Stmt
 
           /* add GOTO back to beginning of condition */
           sprintf(buf, "%d", $2);
-          emit("GOTO", "", "", buf);
+          emit(mkText("GOTO"), mkText(""), mkText(""), mkText(buf));
 
           /* patch IF_FALSE target to instruction after the loop */
           sprintf(buf, "%d", nextInstr());
@@ -178,7 +207,7 @@ M
 N
     : /* empty */
       {
-          emit("IF_FALSE", lastExprTemp, "", "");
+          emit(mkText("IF_FALSE"), lastExprTemp, mkText(""), mkText(""));
           $$ = nextInstr() - 1;   /* index of that IF_FALSE */
       }
     ;
@@ -188,15 +217,15 @@ N
 E
     : E PLUS E
       {
-          char *t = newTemp();
-          emit("+", $1, $3, t);
+          struct text t = newTemp();
+          emit(mkText("+"), $1, $3, t);
           $$ = t;
           lastExprTemp = t;
       }
     | E TIMES E
       {
-          char *t = newTemp();
-          emit("*", $1, $3, t);
+          struct text t = newTemp();
+          emit(mkText("*"), $1, $3, t);
           $$ = t;
           lastExprTemp = t;
       }
@@ -217,7 +246,7 @@ E
       }
     | ID ROP NUM       /* relational: id < num, id == num, etc. */
       {
-          char *t = newTemp();
+          struct text t = newTemp();
           emit($2, $1, $3, t);
           $$ = t;
           lastExprTemp = t;
@@ -226,7 +255,12 @@ E
 
 %%
 
-int main(void) {
+int main(int argc, char **argv) {
+    /* the whole input is loaded up front: argv[1] is mapped, stdin is read */
+    if (scanInput(argc > 1 ? argv[1] : NULL) != 0) {
+        fprintf(stderr, "Error: cannot read %s\n", argc > 1 ? argv[1] : "stdin");
+        return 1;
+    }
     printf("Parsing...\n");
     if (yyparse() == 0) {
         printf("\nParse success.\n");
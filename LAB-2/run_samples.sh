@@ -0,0 +1,76 @@
+#!/bin/sh
+# Regression run for nfa_dfa on the shipped sample NFAs and on broken inputs.
+#
+# The samples must convert cleanly (exit 0, "Process complete."). Each
+# broken input must be rejected with an error message and exit status 1,
+# never a crash, and so must a bad --lazy budget. Last, --bench-load
+# checks saved matchers, including that damaged files are refused, and
+# --bench-find checks the match and token searches against a naive scan.
+# Run from LAB-2; needs c++ and POSIX sh.
+CXX=${CXX:-c++}
+WORK=${WORK:-samples-check}
+
+mkdir -p "$WORK" || exit 1
+$CXX -O2 -std=c++17 -pthread -o "$WORK/nfa_dfa" nfa_dfa.cpp || exit 1
+
+fails=0
+for f in nfa_input.txt output/nfa_input.txt; do
+    if "$WORK/nfa_dfa" --nfa="$f" > "$WORK/out.txt" 2>&1 &&
+       grep -q "Process complete" "$WORK/out.txt"; then
+        echo "ok    $f"
+    else
+        echo "FAIL  $f"; cat "$WORK/out.txt"; fails=$((fails + 1))
+    fi
+done
+
+# name|file contents; every one of these must be rejected
+while IFS='|' read -r name text; do
+    printf "$text" > "$WORK/bad.txt"
+    "$WORK/nfa_dfa" --nfa="$WORK/bad.txt" > "$WORK/out.txt" 2>&1
+    status=$?
+    if [ $status -eq 1 ] && grep -q "bad.txt:" "$WORK/out.txt"; then
+        echo "ok    rejects $name"
+    else
+        echo "FAIL  $name: exit $status"; cat "$WORK/out.txt"; fails=$((fails + 1))
+    fi
+done <<'CASES'
+no start or final line|2 1\na\n0 a 1\n
+no final line|2 1\na\n0 a 1\n0\n
+start out of range|2 1\na\n0 a 1\n7\n1\n
+final out of range|2 1\na\n0 a 1\n0\n2\n
+negative state|2 1\na\n-1 a 1\n0\n1\n
+target out of range|2 1\na\n0 a 99999\n0\n1\n
+symbol not in alphabet|2 1\na\n0 b 1\n0\n1\n
+not a number|2 1\na\n0 a x\n0\n1\n
+empty file|
+old five-field transitions|2 1\na\n0 1 1 a 1\n0\n1\n
+old highest-id header|1 1\na\n0 a 1\n0\n1\n
+CASES
+
+# bad option values must be refused, not quietly replaced by a default
+for arg in --lazy=0 --lazy=x --lazy=-1 --lazy=5k; do
+    "$WORK/nfa_dfa" --grep=nfa_input.txt "$arg" > "$WORK/out.txt" 2>&1
+    status=$?
+    if [ $status -eq 1 ] && grep -q "Error:" "$WORK/out.txt"; then
+        echo "ok    rejects $arg"
+    else
+        echo "FAIL  $arg: exit $status"; cat "$WORK/out.txt"; fails=$((fails + 1))
+    fi
+done
+
+# saved matchers: reload, compare, and refuse damaged files
+if "$WORK/nfa_dfa" --bench-load=12 > "$WORK/out.txt" 2>&1; then
+    echo "ok    --bench-load"
+else
+    echo "FAIL  --bench-load"; cat "$WORK/out.txt"; fails=$((fails + 1))
+fi
+
+# findFirst, findAll and tokenize against a naive scan
+if "$WORK/nfa_dfa" --bench-find=200 > "$WORK/out.txt" 2>&1; then
+    echo "ok    --bench-find"
+else
+    echo "FAIL  --bench-find"; cat "$WORK/out.txt"; fails=$((fails + 1))
+fi
+
+echo "$fails failed"
+[ $fails -eq 0 ]
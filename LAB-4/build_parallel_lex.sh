@@ -0,0 +1,25 @@
+#!/bin/sh
+# Build parallel_lex against both reentrant scanners.
+#
+# The reentrant scanners are not checked in. They are generated here by
+# flex from lexical_analyzer_r.l and ../LAB-11/lexer_r.l on every build,
+# so they always match their .l files. The results go to WORK:
+#   parallel_lex      LAB-4 token listings
+#   parallel_lex11    LAB-11 token listings
+# Knobs: FLEX (default flex), CC (default cc), CFLAGS (default -O2),
+# WORK (default parallel-build). Run from LAB-4; needs flex, cc and
+# POSIX sh.
+set -e
+
+FLEX=${FLEX:-flex}
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:--O2}
+WORK=${WORK:-parallel-build}
+LAB11=../LAB-11
+
+mkdir -p "$WORK"
+$FLEX -o "$WORK/lab4_r.yy.c" lexical_analyzer_r.l
+$FLEX -o "$WORK/lab11_r.yy.c" "$LAB11/lexer_r.l"
+$CC $CFLAGS -pthread -I. -o "$WORK/parallel_lex" parallel_lex.c "$WORK/lab4_r.yy.c"
+$CC $CFLAGS -pthread -I. -I"$LAB11" -o "$WORK/parallel_lex11" parallel_lex.c "$WORK/lab11_r.yy.c"
+echo "Built $WORK/parallel_lex and $WORK/parallel_lex11"
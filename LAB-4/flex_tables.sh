@@ -0,0 +1,98 @@
+#!/bin/sh
+# Compare flex table-compression modes for the LAB-4 and LAB-11 scanners.
+#
+# Every mode is generated from the current .l files into a scratch
+# directory, compiled with -O2 and measured for
+#   - table bytes  (sum of the yy_* tables in the object file)
+#   - binary size  (text + data of the linked program)
+#   - scan speed   (lexbench, MB/s per corpus profile)
+# LAB-4 is timed as "lexer -q file". LAB-11's parser has fixed-size tables,
+# so its scanner is timed on its own through lexer_r.l and parallel_lex -j 1.
+#
+# Afterwards lex.yy.c in both labs is regenerated with the configured mode
+# (the reentrant scanners are not checked in; build_parallel_lex.sh makes
+# them):
+#   FLEX_MODE=default ./flex_tables.sh      use flex's own default (-Cem)
+#   FLEX_MODE=fastest ./flex_tables.sh      use the fastest LAB-4 mode measured
+#   FLEX_MODE=none ./flex_tables.sh         measure only, leave the scanners alone
+# The default is flex's own mode. No mode has been measured yet: the
+# committed lex.yy.c files are the last real flex output and predate the
+# is_keyword() lookup in lexical_analyzer.l, so LAB-4's is stale until this
+# script (or plain flex) is run. Commit WORK/sizes.txt and WORK/speed.txt
+# with the regenerated scanners.
+#
+# Other knobs: SIZES (lexbench --sizes, default 10M), PROFILES (default
+# ident,comment), REPEAT (default 3), WORK (scratch dir, default
+# flex-tables). Run from LAB-4; needs flex, cc, c++ and POSIX sh.
+set -e
+
+FLEX=${FLEX:-flex}
+CC=${CC:-cc}
+CXX=${CXX:-c++}
+FLEX_MODE=${FLEX_MODE:-default}
+SIZES=${SIZES:-10M}
+PROFILES=${PROFILES:-ident,comment}
+REPEAT=${REPEAT:-3}
+WORK=${WORK:-flex-tables}
+LAB11=../LAB-11
+MODES="default -Cf -CF"
+
+mkdir -p "$WORK"
+$CXX -O2 -std=c++17 -o "$WORK/lexbench" ../LAB-1/lexbench.cpp
+
+# mode name -> file-name tag and flex flag ("default" passes no flag)
+tag() { echo "$1" | sed 's/^-//'; }
+flag() { [ "$1" = default ] || echo "$1"; }
+
+table_bytes() {
+    nm -S -t d "$1" | awk '$3 ~ /^[rRdDbB]$/ && $4 ~ /^yy_/ { s += $2 } END { print s + 0 }'
+}
+
+binary_bytes() {
+    size "$1" | awk 'NR == 2 { print $1 + $2 }'
+}
+
+set --
+printf '%-8s %-8s %12s %12s\n' lab mode "table bytes" "binary bytes" > "$WORK/sizes.txt"
+for mode in $MODES; do
+    t=$(tag "$mode")
+    f=$(flag "$mode")
+
+    $FLEX $f -o "$WORK/lab4-$t.c" lexical_analyzer.l
+    $CC -O2 -I. -c -o "$WORK/lab4-$t.o" "$WORK/lab4-$t.c"
+    $CC -o "$WORK/lab4-$t" "$WORK/lab4-$t.o"
+
+    $FLEX $f -o "$WORK/lab11-$t.c" "$LAB11/lexer_r.l"
+    $CC -O2 -I. -I"$LAB11" -c -o "$WORK/lab11-$t.o" "$WORK/lab11-$t.c"
+    $CC -O2 -pthread -I. -o "$WORK/lab11-$t" parallel_lex.c "$WORK/lab11-$t.o"
+
+    for lab in lab4 lab11; do
+        printf '%-8s %-8s %12s %12s\n' "$lab" "$mode" \
+            "$(table_bytes "$WORK/$lab-$t.o")" "$(binary_bytes "$WORK/$lab-$t")" >> "$WORK/sizes.txt"
+    done
+    set -- "$@" "--exe=lab4$t=$PWD/$WORK/lab4-$t -q {}" \
+                "--exe=lab11$t=$PWD/$WORK/lab11-$t -j 1 -q {}"
+done
+
+"$WORK/lexbench" "$@" --sizes="$SIZES" --profiles="$PROFILES" --repeat="$REPEAT" \
+    --dir="$WORK/corpus" | tee "$WORK/speed.txt"
+
+echo
+cat "$WORK/sizes.txt"
+
+if [ "$FLEX_MODE" = fastest ]; then
+    # highest mean LAB-4 MB/s over all sizes and profiles
+    FLEX_MODE=$(awk '$1 ~ /^lab4/ { n[$1]++; s[$1] += $5 }
+                     END { for (k in s) if (s[k] / n[k] > best) { best = s[k] / n[k]; b = k }
+                           print b }' "$WORK/speed.txt" | sed 's/^lab4//')
+    for mode in $MODES; do
+        if [ "$(tag "$mode")" = "$FLEX_MODE" ]; then FLEX_MODE=$mode; fi
+    done
+fi
+if [ "$FLEX_MODE" = none ]; then exit 0; fi
+
+echo
+echo "Regenerating lex.yy.c with mode: $FLEX_MODE"
+f=$(flag "$FLEX_MODE")
+$FLEX $f -o lex.yy.c lexical_analyzer.l
+(cd "$LAB11" && $FLEX $f -o lex.yy.c lexer.l)
@@ -0,0 +1,84 @@
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <stddef.h>
+#include <string.h>
+
+/* Keyword lookup for lexical_analyzer.l and lexical_analyzer_r.l.
+   Keywords are matched by the identifier rule and looked up here, which
+   keeps the 27 keyword paths out of the DFA. The hash (length, first,
+   second and last character) is the one LAB-1 uses and is perfect for
+   this keyword set; empty slots are never keywords. keyword_slots is
+   filled in by hand, so each scanner runs check_keywords() at startup. */
+
+static const char *const keyword_list[] = {
+    "main", "if", "then", "else", "while", "do", "repeat", "until",
+    "for", "from", "to", "step", "switch", "of", "case", "default",
+    "return", "integer", "real", "char", "bool",
+    "and", "or", "not", "mod", "read", "write",
+};
+
+static const char *const keyword_slots[64] = {
+    [0] = "not",
+    [2] = "then",
+    [4] = "until",
+    [5] = "repeat",
+    [7] = "while",
+    [9] = "write",
+    [11] = "real",
+    [13] = "char",
+    [15] = "mod",
+    [18] = "do",
+    [19] = "read",
+    [23] = "case",
+    [25] = "or",
+    [27] = "return",
+    [28] = "switch",
+    [32] = "main",
+    [34] = "to",
+    [35] = "if",
+    [36] = "integer",
+    [40] = "else",
+    [41] = "of",
+    [42] = "for",
+    [43] = "step",
+    [47] = "from",
+    [54] = "and",
+    [56] = "default",
+    [61] = "bool",
+};
+
+static unsigned keyword_slot(const char *s, int n) {
+    return (n + (unsigned char)s[0] + 13 * (unsigned char)s[1]
+            + 7 * (unsigned char)s[n - 1]) & 63;
+}
+
+/* s is NUL-terminated and n == strlen(s), as for yytext and yyleng. */
+static int is_keyword(const char *s, int n) {
+    if (n < 2 || n > 7) return 0;
+    const char *k = keyword_slots[keyword_slot(s, n)];
+    return k && strcmp(k, s) == 0;
+}
+
+/* Every keyword must sit in the slot its hash names and be found by
+   is_keyword(), and the table must hold nothing else. Returns NULL if
+   so, or the first keyword (or stray slot entry) that is wrong. */
+static const char *check_keywords(void) {
+    size_t count = sizeof keyword_list / sizeof *keyword_list, filled = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char *w = keyword_list[i];
+        int n = (int)strlen(w);
+        if (n < 2 || n > 7) return w;
+        const char *k = keyword_slots[keyword_slot(w, n)];
+        if (!k || strcmp(k, w) != 0 || !is_keyword(w, n)) return w;
+    }
+    for (size_t i = 0; i < 64; i++) {
+        if (!keyword_slots[i]) continue;
+        filled++;
+        int n = (int)strlen(keyword_slots[i]);
+        if (n < 2 || n > 7 || keyword_slot(keyword_slots[i], n) != i) return keyword_slots[i];
+    }
+    return filled == count ? NULL : "(keyword_slots has extra entries)";
+}
+
+#endif
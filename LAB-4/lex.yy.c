@@ -510,13 +510,22 @@ char *yytext;
 #line 1 "lexical_analyzer.l"
 #line 2 "lexical_analyzer.l"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 int line = 1;
+int echo_tokens = 1;        // -q turns off the copy on stdout
+FILE *token_file = NULL;    // tokens.txt, opened once in main
 
 void print_token(const char *type, const char *text);
-#line 518 "lex.yy.c"
-#line 519 "lex.yy.c"
+#line 527 "lex.yy.c"
+#line 528 "lex.yy.c"
 
 #define INITIAL 0
 
@@ -733,9 +742,9 @@ YY_DECL
 		}
 
 	{
-#line 12 "lexical_analyzer.l"
+#line 21 "lexical_analyzer.l"
 
-#line 738 "lex.yy.c"
+#line 747 "lex.yy.c"
 
 	while ( /*CONSTCOND*/1 )		/* loops until end-of-file is reached */
 		{
@@ -794,66 +803,66 @@ do_action:	/* This label is used only to access EOF actions. */
 
 case 1:
 YY_RULE_SETUP
-#line 13 "lexical_analyzer.l"
+#line 22 "lexical_analyzer.l"
 
 	YY_BREAK
 case 2:
 YY_RULE_SETUP
-#line 14 "lexical_analyzer.l"
+#line 23 "lexical_analyzer.l"
 
 	YY_BREAK
 case 3:
 YY_RULE_SETUP
-#line 15 "lexical_analyzer.l"
+#line 24 "lexical_analyzer.l"
 
 	YY_BREAK
 case 4:
 YY_RULE_SETUP
-#line 16 "lexical_analyzer.l"
+#line 25 "lexical_analyzer.l"
 { print_token("KEYWORD", yytext); }
 	YY_BREAK
 case 5:
 YY_RULE_SETUP
-#line 18 "lexical_analyzer.l"
+#line 27 "lexical_analyzer.l"
 { print_token("OPERATOR", yytext); }
 	YY_BREAK
 case 6:
 YY_RULE_SETUP
-#line 20 "lexical_analyzer.l"
+#line 29 "lexical_analyzer.l"
 { print_token("DELIMITER", yytext); }
 	YY_BREAK
 case 7:
 YY_RULE_SETUP
-#line 22 "lexical_analyzer.l"
+#line 31 "lexical_analyzer.l"
 { print_token("IDENTIFIER", yytext); }
 	YY_BREAK
 case 8:
 YY_RULE_SETUP
-#line 24 "lexical_analyzer.l"
+#line 33 "lexical_analyzer.l"
 { print_token("NUMBER", yytext); }
 	YY_BREAK
 case 9:
 YY_RULE_SETUP
-#line 26 "lexical_analyzer.l"
+#line 35 "lexical_analyzer.l"
 { /* ignore whitespace */ }
 	YY_BREAK
 case 10:
 /* rule 10 can match eol */
 YY_RULE_SETUP
-#line 28 "lexical_analyzer.l"
+#line 37 "lexical_analyzer.l"
 { line++; }
 	YY_BREAK
 case 11:
 YY_RULE_SETUP
-#line 30 "lexical_analyzer.l"
+#line 39 "lexical_analyzer.l"
 { printf("Unknown symbol: %s\n", yytext); }
 	YY_BREAK
 case 12:
 YY_RULE_SETUP
-#line 31 "lexical_analyzer.l"
+#line 40 "lexical_analyzer.l"
 ECHO;
 	YY_BREAK
-#line 856 "lex.yy.c"
+#line 865 "lex.yy.c"
 case YY_STATE_EOF(INITIAL):
 	yyterminate();
 
@@ -1858,32 +1867,131 @@ void yyfree (void * ptr )
 
 #define YYTABLES_NAME "yytables"
 
-#line 31 "lexical_analyzer.l"
+#line 40 "lexical_analyzer.l"
 
 
 void print_token(const char *type, const char *text) {
-    FILE *fp = fopen("tokens.txt", "a");
-    fprintf(fp, "<%s, %s>\n", type, text);
-    fclose(fp);
-    printf("<%s, %s>\n", type, text);
+    // One buffered stream for the whole run instead of fopen/fclose per token
+    fputs("<", token_file);
+    fputs(type, token_file);
+    fputs(", ", token_file);
+    fputs(text, token_file);
+    fputs(">\n", token_file);
+    if (echo_tokens) {
+        fputs("<", stdout);
+        fputs(type, stdout);
+        fputs(", ", stdout);
+        fputs(text, stdout);
+        fputs(">\n", stdout);
+    }
+}
+
+// -m: scan the whole file in place with yy_scan_buffer instead of
+// through yyin. flex needs two NUL bytes after the text, so reserve
+// size + 2 bytes of zeroed anonymous memory and map the file over the
+// front of it: the sentinels land in the zero tail of the file's last
+// page or in the anonymous page after it. The mapping is private and
+// writable because flex stores a NUL after each token while scanning.
+char *load_input(const char *path, size_t *size, size_t *mapped) {
+    *mapped = 0;
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t len = ((size_t)st.st_size + 2 + page - 1) / page * page;
+        char *base = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base != MAP_FAILED) {
+            if (mmap(base, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+                close(fd);
+                *size = (size_t)st.st_size;
+                *mapped = len;
+                return base;
+            }
+            munmap(base, len);
+        }
+    }
+    close(fd);
+#endif
+    // Not mappable (empty file, pipe, Windows): read it into memory
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    size_t cap = 1 << 16, n = 0, got;
+    char *buf = malloc(cap + 2);
+    while (buf && (got = fread(buf + n, 1, cap - n, f)) > 0) {
+        n += got;
+        if (n == cap) {
+            cap *= 2;
+            char *grown = realloc(buf, cap + 2);
+            if (!grown) free(buf);
+            buf = grown;
+        }
+    }
+    fclose(f);
+    if (!buf) return NULL;
+    buf[n] = buf[n + 1] = 0;
+    *size = n;
+    return buf;
+}
+
+void release_input(char *buf, size_t mapped) {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(buf, mapped);
+        return;
+    }
+#endif
+    free(buf);
 }
 
 int main(int argc, char **argv) {
-    if (argc < 2) {
-        printf("Usage: %s <inputfile>\n", argv[0]);
+    static char token_buf[1 << 16];
+    const char *path = NULL;
+    int map_input = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) echo_tokens = 0;
+        else if (strcmp(argv[i], "-m") == 0) map_input = 1;
+        else path = argv[i];
+    }
+    if (!path) {
+        printf("Usage: %s [-q] [-m] <inputfile>\n", argv[0]);
         return 1;
     }
 
-    FILE *f = fopen(argv[1], "r");
-    if (!f) {
-        printf("Cannot open file %s\n", argv[1]);
+    FILE *f = NULL;
+    char *buf = NULL;
+    size_t size = 0, mapped = 0;
+    if (map_input) buf = load_input(path, &size, &mapped);
+    else f = fopen(path, "r");
+    if (!f && !buf) {
+        printf("Cannot open file %s\n", path);
         return 1;
     }
 
-    yyin = f;
-    remove("tokens.txt");   // clear old file
-    yylex();
-    fclose(f);
+    token_file = fopen("tokens.txt", "w");   // clear old file
+    if (!token_file) {
+        printf("Cannot open file tokens.txt\n");
+        if (f) fclose(f);
+        if (buf) release_input(buf, mapped);
+        return 1;
+    }
+    setvbuf(token_file, token_buf, _IOFBF, sizeof token_buf);
+
+    if (buf) {
+        YY_BUFFER_STATE b = yy_scan_buffer(buf, size + 2);
+        yylex();
+        yy_delete_buffer(b);
+        release_input(buf, mapped);
+    } else {
+        yyin = f;
+        yylex();
+        fclose(f);
+    }
+    fclose(token_file);                      // flushes the last block
     printf("\nTokens saved in tokens.txt\n");
     return 0;
 }
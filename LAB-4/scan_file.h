@@ -0,0 +1,24 @@
+#ifndef SCAN_FILE_H
+#define SCAN_FILE_H
+
+#include <stddef.h>
+
+/* Result of lexing one file with a reentrant scanner.
+   Everything the scanner would have printed is collected in text so the
+   driver can print files in input order no matter which thread ran them. */
+struct scan_result {
+    char  *text;     /* token listing, malloc'd, NUL-terminated */
+    size_t len;      /* bytes in text */
+    long   tokens;   /* tokens recognised */
+    long   unknown;  /* characters that matched no rule */
+    int    lines;    /* input lines */
+    int    error;    /* nonzero if the file could not be opened */
+};
+
+/* Implemented in the user-code section of each reentrant .l file.
+   Safe to call from several threads at once. Returns 0 on success. */
+int scan_file(const char *path, struct scan_result *r);
+
+void free_scan_result(struct scan_result *r);
+
+#endif